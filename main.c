@@ -2,13 +2,16 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <math.h>
 #include <readline/readline.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -16,10 +19,31 @@
 
 #define WT_DEFAULT_DATA_DIR ".local/share/wt"
 #define WEIGHT_HISTORY_DEFAULT_FILE ".local/share/wt/weight_history.csv"
+#define WEIGHT_STORE_DEFAULT_FILE ".local/share/wt/weight_history.db"
+#define WT_JOURNAL_SUFFIX ".journal"
+
+#define WT_STORE_MAGIC "WTDB"
+#define WT_STORE_VERSION 2
+#define WT_STORE_VERSION_SINGLE 1 ///< Single series, migrated on compaction.
+#define WT_STORE_BLOCK_RECORDS 256
+#define WT_JOURNAL_MAGIC "WTJL"
+#define WT_JOURNAL_VERSION 2
+#define WT_JOURNAL_COMPACT_THRESHOLD (64 * 1024) ///< Bytes.
+
+#define WT_PROFILE_DEFAULT "default"
+#define WT_PROFILE_NAME_MAX_SIZE 32
 
 #define WT_AVG_DEFAULT_WINDOW_LENGTH_DAYS 7
 
-#define FILE_PATH_MAX_SIZE 128
+#define WT_RESAMPLE_MAX_DAYS (1 << 20) ///< Upper bound on the day grid span.
+
+#define WT_SKETCH_K 128 ///< Items per sketch level; error shrinks as 1/K.
+#define WT_SKETCH_MAX_LEVELS 32
+#define WT_SKETCH_FILE_MAGIC "WTQS"
+#define WT_SKETCH_FILE_VERSION 1
+#define WT_DIST_MAX_WINDOW_DAYS (100 * 366) ///< A century.
+
+#define FILE_PATH_MAX_SIZE PATH_MAX
 
 enum wt_cmd_tag {
   WT_CMD_LOG_WEIGHT,
@@ -27,12 +51,21 @@ enum wt_cmd_tag {
   WT_CMD_AVG,
   WT_CMD_STATS,
   WT_CMD_SHOW,
+  WT_CMD_DIST,
+  WT_CMD_COMPACT,
   WT_CMDS_NUMBER,
 };
 
+struct wt_store {
+  char path[FILE_PATH_MAX_SIZE];         ///< Sorted, date-indexed base file.
+  char journal_path[FILE_PATH_MAX_SIZE]; ///< Entries logged since compaction.
+  char legacy_path[FILE_PATH_MAX_SIZE];  ///< CSV history seeding a new base.
+  char profile[WT_PROFILE_NAME_MAX_SIZE]; ///< Series read and logged to.
+};
+
 struct wt_cmd_log_weight_args {
   float weight;
-  char file_path[FILE_PATH_MAX_SIZE];
+  struct wt_store store;
 };
 
 struct wt_data {
@@ -42,23 +75,48 @@ struct wt_data {
   float muscle_mass_percent;
 };
 
+struct wt_record {
+  int32_t day; ///< Days since 1970-01-01.
+  struct wt_data data;
+};
+
 struct wt_cmd_log_data_args {
   struct wt_data data;
-  char file_path[FILE_PATH_MAX_SIZE];
+  struct wt_store store;
 };
 
 struct wt_cmd_avg_args {
   uint8_t avg_window_days;
-  char file_path[FILE_PATH_MAX_SIZE];
+  bool fill_gaps;
+  struct wt_store store;
 };
 
 struct wt_cmd_stats_args {
   uint8_t avg_window_days;
-  char file_path[FILE_PATH_MAX_SIZE];
+  bool fill_gaps;
+  struct wt_store store;
 };
 
 struct wt_cmd_show_args {
-  char file_path[FILE_PATH_MAX_SIZE];
+  struct wt_store store;
+  char file_path[FILE_PATH_MAX_SIZE]; ///< CSV to show instead, if not empty.
+  int32_t from_day; ///< First day shown from the store.
+  int32_t to_day;   ///< Last day shown from the store.
+};
+
+struct wt_cmd_dist_args {
+  uint32_t window_days; ///< 0 reports the whole history as one window.
+  bool merge;           ///< Inputs are saved sketches rather than CSV files.
+  char save_path[FILE_PATH_MAX_SIZE]; ///< Empty if sketches are not saved.
+  size_t input_count;
+  char *const *inputs; ///< The store is read if `input_count` is 0.
+  struct wt_store store;
+  int32_t from_day; ///< First day read from the store or CSV files.
+  int32_t to_day;   ///< Last day read from the store or CSV files.
+};
+
+struct wt_cmd_compact_args {
+  struct wt_store store;
 };
 
 struct wt_cmd {
@@ -70,6 +128,8 @@ struct wt_cmd {
     struct wt_cmd_avg_args avg_args;
     struct wt_cmd_stats_args stats_args;
     struct wt_cmd_show_args show_args;
+    struct wt_cmd_dist_args dist_args;
+    struct wt_cmd_compact_args compact_args;
   };
 };
 
@@ -114,70 +174,71 @@ static float compute_s0xy(size_t data_length, float const x[data_length],
   return res;
 }
 
-static int linear_fit(size_t data_length, float const data[data_length],
+static int linear_fit(size_t data_length, float const x[data_length],
+                      float const y[data_length],
                       struct linear_fit_coeff *linear_fit) {
   if (data_length == 0) {
     return -1;
   }
-  float *x = calloc(data_length, sizeof(*x));
-  for (size_t i = 0; i < data_length; i++) {
-    x[i] = i;
-  }
-  float const s0x = (float)data_length;
-  float const s1x = data_length * (data_length - 1) / 2.0;
-  float const s2x =
-      data_length * (data_length - 1) * (2 * data_length - 1) / 6.0;
-  float const s0xy = compute_s0xy(data_length, x, data);
-  float const s1xy = compute_skxy(data_length, x, data, 1);
+  float const s0x = compute_skx(data_length, x, 0);
+  float const s1x = compute_skx(data_length, x, 1);
+  float const s2x = compute_skx(data_length, x, 2);
+  float const s0xy = compute_s0xy(data_length, x, y);
+  float const s1xy = compute_skxy(data_length, x, y, 1);
   linear_fit->m = (s0x * s1xy - s1x * s0xy) / (s0x * s2x - s1x * s1x);
   linear_fit->q = (s0xy * s2x - s1xy * s1x) / (s0x * s2x - s1x * s1x);
-  free(x);
   return 0;
 }
 
-#define wt_load_data(dst, data, data_len, attr)                                \
+/// Loads the non-NaN values of `attr` into `dst_y`, and their index in `data`
+/// (i.e. the day offset for calendar-resampled data) into `dst_x`.
+#define wt_load_data(dst_x, dst_y, data, data_len, attr)                       \
   size_t attr##_length = 0;                                                    \
   for (size_t i = 0; i < data_len; i++) {                                      \
     if (isnan(data[i].attr)) {                                                 \
       continue;                                                                \
     }                                                                          \
-    dst[i] = data[i].attr;                                                     \
+    dst_x[attr##_length] = i;                                                  \
+    dst_y[attr##_length] = data[i].attr;                                       \
     attr##_length++;                                                           \
   }
 
 static int wt_stats_from_history(struct wt_stats *self, size_t history_length,
                                  struct wt_data const history[history_length]) {
   int res = 0;
+  float *x = calloc(history_length, sizeof(*x));
   float *data = calloc(history_length, sizeof(*data));
-  if (data == NULL) {
-    return -1;
+  if (x == NULL || data == NULL) {
+    res = -1;
+    goto cleanup;
   }
   struct linear_fit_coeff lfit = {0};
-  wt_load_data(data, history, history_length, weight_kg);
-  if (linear_fit(weight_kg_length, data, &lfit) < 0) {
+  wt_load_data(x, data, history, history_length, weight_kg);
+  if (linear_fit(weight_kg_length, x, data, &lfit) < 0) {
     res = -1;
     goto cleanup;
   }
   self->weight_kg_rate_of_change = lfit.m;
-  wt_load_data(data, history, history_length, body_fat_percent);
-  if (linear_fit(body_fat_percent_length, data, &lfit) < 0) {
+  wt_load_data(x, data, history, history_length, body_fat_percent);
+  if (linear_fit(body_fat_percent_length, x, data, &lfit) < 0) {
     res = -1;
     goto cleanup;
   }
   self->body_fat_percent_rate_of_change = lfit.m;
-  wt_load_data(data, history, history_length, muscle_mass_percent);
-  if (linear_fit(muscle_mass_percent_length, data, &lfit) < 0) {
+  wt_load_data(x, data, history, history_length, muscle_mass_percent);
+  if (linear_fit(muscle_mass_percent_length, x, data, &lfit) < 0) {
     res = -1;
     goto cleanup;
   }
   self->muscle_mass_percent_rate_of_change = lfit.m;
-  wt_load_data(data, history, history_length, water_mass_percent);
-  if (linear_fit(water_mass_percent_length, data, &lfit) < 0) {
+  wt_load_data(x, data, history, history_length, water_mass_percent);
+  if (linear_fit(water_mass_percent_length, x, data, &lfit) < 0) {
     res = -1;
     goto cleanup;
   }
   self->water_mass_percent_rate_of_change = lfit.m;
 cleanup:
+  free(x);
   free(data);
   return res;
 }
@@ -195,6 +256,417 @@ static void wt_stats_print(struct wt_stats const *self) {
          self->water_mass_percent_rate_of_change);
 }
 
+struct wt_sketch {
+  uint64_t n;
+  float min;
+  float max;
+  uint32_t rng;
+  uint32_t level_count;
+  uint32_t level_size[WT_SKETCH_MAX_LEVELS];
+  float *levels[WT_SKETCH_MAX_LEVELS]; ///< Items at level h weigh 2^h.
+};
+
+static void wt_sketch_init(struct wt_sketch *self) {
+  memset(self, 0, sizeof(*self));
+  self->min = nanf("nan");
+  self->max = nanf("nan");
+  self->rng = 0x9e3779b9;
+}
+
+static void wt_sketch_free(struct wt_sketch *self) {
+  for (uint32_t h = 0; h < self->level_count; h++) {
+    free(self->levels[h]);
+  }
+  wt_sketch_init(self);
+}
+
+static int wt_float_cmp(void const *a, void const *b) {
+  float const lhs = *(float const *)a;
+  float const rhs = *(float const *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static int wt_sketch_push(struct wt_sketch *self, uint32_t level, float item);
+
+/// Sorts a full level and promotes every other item, starting at a random
+/// parity, to the next level with twice the weight.
+static int wt_sketch_compact(struct wt_sketch *self, uint32_t level) {
+  if (level + 1 == WT_SKETCH_MAX_LEVELS) {
+    return -1;
+  }
+  float *items = self->levels[level];
+  uint32_t const size = self->level_size[level];
+  uint32_t const even_size = size & ~1u;
+  qsort(items, size, sizeof(*items), wt_float_cmp);
+  self->rng ^= self->rng << 13;
+  self->rng ^= self->rng >> 17;
+  self->rng ^= self->rng << 5;
+  self->level_size[level] = 0;
+  for (uint32_t i = self->rng & 1; i < even_size; i += 2) {
+    if (wt_sketch_push(self, level + 1, items[i]) < 0) {
+      return -1;
+    }
+  }
+  if (size != even_size) {
+    items[self->level_size[level]++] = items[size - 1];
+  }
+  return 0;
+}
+
+static int wt_sketch_push(struct wt_sketch *self, uint32_t level, float item) {
+  while (self->level_count <= level) {
+    float **items = &self->levels[self->level_count];
+    *items = calloc(WT_SKETCH_K, sizeof(**items));
+    if (*items == NULL) {
+      return -1;
+    }
+    self->level_count++;
+  }
+  self->levels[level][self->level_size[level]++] = item;
+  if (self->level_size[level] == WT_SKETCH_K) {
+    return wt_sketch_compact(self, level);
+  }
+  return 0;
+}
+
+static int wt_sketch_update(struct wt_sketch *self, float item) {
+  if (isnan(item)) {
+    return 0;
+  }
+  self->min = self->n == 0 || item < self->min ? item : self->min;
+  self->max = self->n == 0 || item > self->max ? item : self->max;
+  self->n++;
+  return wt_sketch_push(self, 0, item);
+}
+
+static int wt_sketch_merge(struct wt_sketch *self,
+                           struct wt_sketch const *other) {
+  if (other->n == 0) {
+    return 0;
+  }
+  self->min = self->n == 0 || other->min < self->min ? other->min : self->min;
+  self->max = self->n == 0 || other->max > self->max ? other->max : self->max;
+  self->n += other->n;
+  for (uint32_t h = 0; h < other->level_count; h++) {
+    for (uint32_t i = 0; i < other->level_size[h]; i++) {
+      if (wt_sketch_push(self, h, other->levels[h][i]) < 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+struct wt_weighted_item {
+  float item;
+  uint64_t weight;
+};
+
+static int wt_weighted_item_cmp(void const *a, void const *b) {
+  return wt_float_cmp(&((struct wt_weighted_item const *)a)->item,
+                      &((struct wt_weighted_item const *)b)->item);
+}
+
+/// Estimates the `q`-quantile, for `q` in [0, 1]. The extremes are exact.
+static float wt_sketch_quantile(struct wt_sketch const *self, float q) {
+  if (self->n == 0) {
+    return nanf("nan");
+  }
+  if (q <= 0) {
+    return self->min;
+  }
+  if (q >= 1) {
+    return self->max;
+  }
+  size_t items_length = 0;
+  for (uint32_t h = 0; h < self->level_count; h++) {
+    items_length += self->level_size[h];
+  }
+  struct wt_weighted_item *items = calloc(items_length, sizeof(*items));
+  if (items == NULL) {
+    return nanf("nan");
+  }
+  size_t j = 0;
+  for (uint32_t h = 0; h < self->level_count; h++) {
+    for (uint32_t i = 0; i < self->level_size[h]; i++) {
+      items[j].item = self->levels[h][i];
+      items[j].weight = (uint64_t)1 << h;
+      j++;
+    }
+  }
+  qsort(items, items_length, sizeof(*items), wt_weighted_item_cmp);
+  double const rank = q * (double)self->n;
+  uint64_t cumulative_weight = 0;
+  float res = self->max;
+  for (size_t i = 0; i < items_length; i++) {
+    cumulative_weight += items[i].weight;
+    if (cumulative_weight >= rank) {
+      res = items[i].item;
+      break;
+    }
+  }
+  free(items);
+  return res;
+}
+
+static int wt_sketch_write(struct wt_sketch const *self, FILE *f) {
+  if (fwrite(&self->n, sizeof(self->n), 1, f) != 1 ||
+      fwrite(&self->min, sizeof(self->min), 1, f) != 1 ||
+      fwrite(&self->max, sizeof(self->max), 1, f) != 1 ||
+      fwrite(&self->level_count, sizeof(self->level_count), 1, f) != 1) {
+    return -1;
+  }
+  for (uint32_t h = 0; h < self->level_count; h++) {
+    uint32_t const size = self->level_size[h];
+    if (fwrite(&size, sizeof(size), 1, f) != 1 ||
+        fwrite(self->levels[h], sizeof(*self->levels[h]), size, f) != size) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/// Reads a sketch written by `wt_sketch_write` into an initialized sketch.
+static int wt_sketch_read(struct wt_sketch *self, FILE *f) {
+  if (fread(&self->n, sizeof(self->n), 1, f) != 1 ||
+      fread(&self->min, sizeof(self->min), 1, f) != 1 ||
+      fread(&self->max, sizeof(self->max), 1, f) != 1) {
+    return -1;
+  }
+  uint32_t level_count;
+  if (fread(&level_count, sizeof(level_count), 1, f) != 1 ||
+      level_count > WT_SKETCH_MAX_LEVELS) {
+    return -1;
+  }
+  for (uint32_t h = 0; h < level_count; h++) {
+    uint32_t size;
+    if (fread(&size, sizeof(size), 1, f) != 1 || size >= WT_SKETCH_K) {
+      return -1;
+    }
+    self->levels[h] = calloc(WT_SKETCH_K, sizeof(*self->levels[h]));
+    if (self->levels[h] == NULL) {
+      return -1;
+    }
+    self->level_count++;
+    if (fread(self->levels[h], sizeof(*self->levels[h]), size, f) != size) {
+      return -1;
+    }
+    self->level_size[h] = size;
+  }
+  return 0;
+}
+
+/// Per-metric sketches of the readings falling in
+/// [start_day, start_day + window_days).
+struct wt_dist_window {
+  int32_t start_day;
+  struct wt_sketch weight_kg;
+  struct wt_sketch body_fat_percent;
+  struct wt_sketch muscle_mass_percent;
+  struct wt_sketch water_mass_percent;
+};
+
+struct wt_dist {
+  uint32_t window_days;
+  size_t length;
+  size_t capacity;
+  struct wt_dist_window **windows; ///< Sorted by `start_day`.
+};
+
+static void wt_dist_init(struct wt_dist *self, uint32_t window_days) {
+  memset(self, 0, sizeof(*self));
+  self->window_days = window_days;
+}
+
+static void wt_dist_free(struct wt_dist *self) {
+  for (size_t i = 0; i < self->length; i++) {
+    wt_sketch_free(&self->windows[i]->weight_kg);
+    wt_sketch_free(&self->windows[i]->body_fat_percent);
+    wt_sketch_free(&self->windows[i]->muscle_mass_percent);
+    wt_sketch_free(&self->windows[i]->water_mass_percent);
+    free(self->windows[i]);
+  }
+  free(self->windows);
+  wt_dist_init(self, self->window_days);
+}
+
+/// Returns the window starting at `start_day`, creating it if needed.
+/// Histories are mostly chronological, so the last window is tried first.
+static struct wt_dist_window *wt_dist_get_window(struct wt_dist *self,
+                                                 int32_t start_day) {
+  size_t lo = 0;
+  size_t hi = self->length;
+  if (hi > 0 && self->windows[hi - 1]->start_day < start_day) {
+    lo = hi;
+  }
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    if (self->windows[mid]->start_day == start_day) {
+      return self->windows[mid];
+    }
+    if (self->windows[mid]->start_day > start_day) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  if (self->length == self->capacity) {
+    size_t const capacity = self->capacity == 0 ? 16 : 2 * self->capacity;
+    struct wt_dist_window **windows =
+        realloc(self->windows, capacity * sizeof(*windows));
+    if (windows == NULL) {
+      return NULL;
+    }
+    self->windows = windows;
+    self->capacity = capacity;
+  }
+  struct wt_dist_window *window = calloc(1, sizeof(*window));
+  if (window == NULL) {
+    return NULL;
+  }
+  window->start_day = start_day;
+  wt_sketch_init(&window->weight_kg);
+  wt_sketch_init(&window->body_fat_percent);
+  wt_sketch_init(&window->muscle_mass_percent);
+  wt_sketch_init(&window->water_mass_percent);
+  memmove(&self->windows[lo + 1], &self->windows[lo],
+          (self->length - lo) * sizeof(*self->windows));
+  self->windows[lo] = window;
+  self->length++;
+  return window;
+}
+
+static int wt_dist_update(struct wt_dist *self, int32_t day,
+                          struct wt_data const *data) {
+  int32_t start_day = 0;
+  if (self->window_days != 0) {
+    int32_t const w = (int32_t)self->window_days;
+    start_day = (day >= 0 ? day / w : (day - w + 1) / w) * w;
+  }
+  struct wt_dist_window *window = wt_dist_get_window(self, start_day);
+  if (window == NULL) {
+    return -1;
+  }
+  if (wt_sketch_update(&window->weight_kg, data->weight_kg) < 0 ||
+      wt_sketch_update(&window->body_fat_percent, data->body_fat_percent) <
+          0 ||
+      wt_sketch_update(&window->muscle_mass_percent,
+                       data->muscle_mass_percent) < 0 ||
+      wt_sketch_update(&window->water_mass_percent, data->water_mass_percent) <
+          0) {
+    return -1;
+  }
+  return 0;
+}
+
+static int wt_dist_write(struct wt_dist const *self, char const *path) {
+  int res = 0;
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    res = -1;
+    goto exit;
+  }
+  uint32_t const version = WT_SKETCH_FILE_VERSION;
+  uint32_t const k = WT_SKETCH_K;
+  uint64_t const length = self->length;
+  if (fwrite(WT_SKETCH_FILE_MAGIC, 4, 1, f) != 1 ||
+      fwrite(&version, sizeof(version), 1, f) != 1 ||
+      fwrite(&k, sizeof(k), 1, f) != 1 ||
+      fwrite(&self->window_days, sizeof(self->window_days), 1, f) != 1 ||
+      fwrite(&length, sizeof(length), 1, f) != 1) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t i = 0; i < self->length; i++) {
+    struct wt_dist_window const *window = self->windows[i];
+    if (fwrite(&window->start_day, sizeof(window->start_day), 1, f) != 1 ||
+        wt_sketch_write(&window->weight_kg, f) < 0 ||
+        wt_sketch_write(&window->body_fat_percent, f) < 0 ||
+        wt_sketch_write(&window->muscle_mass_percent, f) < 0 ||
+        wt_sketch_write(&window->water_mass_percent, f) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  }
+cleanup:
+  if (fclose(f) != 0) {
+    res = -1;
+  }
+exit:
+  return res;
+}
+
+/// Merges the sketches saved at `path` into `self`. Both must use the same
+/// window length.
+static int wt_dist_merge_file(struct wt_dist *self, char const *path) {
+  int res = 0;
+  struct wt_dist_window window;
+  wt_sketch_init(&window.weight_kg);
+  wt_sketch_init(&window.body_fat_percent);
+  wt_sketch_init(&window.muscle_mass_percent);
+  wt_sketch_init(&window.water_mass_percent);
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    res = -1;
+    goto exit;
+  }
+  char magic[4];
+  uint32_t version, k, window_days;
+  uint64_t length;
+  if (fread(magic, sizeof(magic), 1, f) != 1 ||
+      memcmp(magic, WT_SKETCH_FILE_MAGIC, sizeof(magic)) != 0 ||
+      fread(&version, sizeof(version), 1, f) != 1 ||
+      version != WT_SKETCH_FILE_VERSION ||
+      fread(&k, sizeof(k), 1, f) != 1 || k != WT_SKETCH_K ||
+      fread(&window_days, sizeof(window_days), 1, f) != 1 ||
+      window_days != self->window_days ||
+      fread(&length, sizeof(length), 1, f) != 1) {
+    res = -1;
+    goto cleanup;
+  }
+  for (uint64_t i = 0; i < length; i++) {
+    if (fread(&window.start_day, sizeof(window.start_day), 1, f) != 1 ||
+        wt_sketch_read(&window.weight_kg, f) < 0 ||
+        wt_sketch_read(&window.body_fat_percent, f) < 0 ||
+        wt_sketch_read(&window.muscle_mass_percent, f) < 0 ||
+        wt_sketch_read(&window.water_mass_percent, f) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+    struct wt_dist_window *dst = wt_dist_get_window(self, window.start_day);
+    if (dst == NULL ||
+        wt_sketch_merge(&dst->weight_kg, &window.weight_kg) < 0 ||
+        wt_sketch_merge(&dst->body_fat_percent, &window.body_fat_percent) < 0 ||
+        wt_sketch_merge(&dst->muscle_mass_percent,
+                        &window.muscle_mass_percent) < 0 ||
+        wt_sketch_merge(&dst->water_mass_percent, &window.water_mass_percent) <
+            0) {
+      res = -1;
+      goto cleanup;
+    }
+    wt_sketch_free(&window.weight_kg);
+    wt_sketch_free(&window.body_fat_percent);
+    wt_sketch_free(&window.muscle_mass_percent);
+    wt_sketch_free(&window.water_mass_percent);
+  }
+cleanup:
+  fclose(f);
+exit:
+  wt_sketch_free(&window.weight_kg);
+  wt_sketch_free(&window.body_fat_percent);
+  wt_sketch_free(&window.muscle_mass_percent);
+  wt_sketch_free(&window.water_mass_percent);
+  return res;
+}
+
+static void wt_sketch_print(char const *name, struct wt_sketch const *self) {
+  printf("  %-12s%8llu%8.2f%8.2f%8.2f%8.2f%8.2f%8.2f%8.2f\n", name,
+         (unsigned long long)self->n, self->min,
+         wt_sketch_quantile(self, 0.10f), wt_sketch_quantile(self, 0.25f),
+         wt_sketch_quantile(self, 0.50f), wt_sketch_quantile(self, 0.75f),
+         wt_sketch_quantile(self, 0.90f), self->max);
+}
+
 static int wt_cmd_execute(struct wt_cmd const *cmd) {
   int res = -1;
   switch (cmd->tag) {
@@ -213,6 +685,12 @@ static int wt_cmd_execute(struct wt_cmd const *cmd) {
   case WT_CMD_SHOW:
     res = cmd->execute_func((void *)&cmd->show_args);
     break;
+  case WT_CMD_DIST:
+    res = cmd->execute_func((void *)&cmd->dist_args);
+    break;
+  case WT_CMD_COMPACT:
+    res = cmd->execute_func((void *)&cmd->compact_args);
+    break;
   default:
     res = -1;
     break;
@@ -220,52 +698,6 @@ static int wt_cmd_execute(struct wt_cmd const *cmd) {
   return res;
 }
 
-static int log_weight_get_fd(char const *path) {
-  int fd;
-  if (access(path, F_OK) != 0) {
-    fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRWXU);
-    static char const *header = "day,weight(kg),body_fat(%),muscle_mass(%),"
-                                "water_mass(%)\n";
-    write(fd, header, strlen(header));
-  } else {
-    fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRWXU);
-  }
-  return fd;
-}
-
-static size_t log_weight_format_std(time_t unix_time, float weight,
-                                    size_t buff_size, char buff[buff_size]) {
-  char date_buff[32];
-  strftime(date_buff, sizeof(date_buff), "%d/%m/%Y", localtime(&unix_time));
-  return snprintf(buff, buff_size, "%s,%.2f,NA,NA,NA\n", date_buff, weight);
-}
-
-static size_t log_data_format_std(time_t unix_time, struct wt_data const *data,
-                                  size_t buff_size, char buff[buff_size]) {
-  char date_buff[32];
-  strftime(date_buff, sizeof(date_buff), "%d/%m/%Y", localtime(&unix_time));
-  return snprintf(buff, buff_size, "%s,%.2f,%.2f,%.2f,%.2f\n", date_buff,
-                  data->weight_kg, data->body_fat_percent,
-                  data->muscle_mass_percent, data->water_mass_percent);
-}
-
-static int log_weight(void const *args) {
-  int res = 0;
-  struct wt_cmd_log_weight_args const *log_weight_args = args;
-  int fd = log_weight_get_fd(log_weight_args->file_path);
-  if (fd < 0) {
-    res = -1;
-    goto exit;
-  }
-  char buff[256];
-  size_t length = log_weight_format_std(time(NULL), log_weight_args->weight,
-                                        sizeof(buff), buff);
-  write(fd, buff, length);
-  close(fd);
-exit:
-  return res;
-}
-
 static int wt_data_from_stdin(struct wt_data *data) {
   int res = 0;
   char *buffer = readline("Weight (Kg): ");
@@ -300,23 +732,6 @@ exit:
   return res;
 }
 
-static int log_data(void const *args) {
-  int res = 0;
-  struct wt_cmd_log_data_args const *log_data_args = args;
-  int fd = log_weight_get_fd(log_data_args->file_path);
-  if (fd < 0) {
-    res = -1;
-    goto exit;
-  }
-  char buff[256];
-  size_t length =
-      log_data_format_std(time(NULL), &log_data_args->data, sizeof(buff), buff);
-  write(fd, buff, length);
-  close(fd);
-exit:
-  return res;
-}
-
 float wt_float_from_str(char const *str) {
   if (strcmp(str, "NA") == 0) {
     return strtof("nan", NULL);
@@ -357,9 +772,57 @@ exit:
   return res;
 }
 
-static ssize_t wt_get_history(char const *history_file_path,
+/// Days since 1970-01-01 of the proleptic Gregorian date `y-m-d`.
+static int32_t wt_day_from_civil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t const era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t const yoe = (uint32_t)(y - era * 400);
+  uint32_t const doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  uint32_t const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+/// Formats `day`, in days since 1970-01-01, as a `%d/%m/%Y` date.
+static void wt_date_str_from_day(int32_t day, size_t buff_size,
+                                 char buff[buff_size]) {
+  day += 719468;
+  int32_t const era = (day >= 0 ? day : day - 146096) / 146097;
+  uint32_t const doe = (uint32_t)(day - era * 146097);
+  uint32_t const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t const mp = (5 * doy + 2) / 153;
+  uint32_t const d = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t const m = mp < 10 ? mp + 3 : mp - 9;
+  int32_t const y = (int32_t)yoe + era * 400 + (m <= 2);
+  snprintf(buff, buff_size, "%02u/%02u/%04d", d, m, y);
+}
+
+/// Number of days of month `m` of year `y`, in the proleptic Gregorian
+/// calendar.
+static int wt_days_in_month(int y, int m) {
+  static int const days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool const leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+  return m == 2 && leap ? 29 : days[m - 1];
+}
+
+/// Parses a `%d/%m/%Y` date as written by the log commands. Dates that do not
+/// exist, such as 31/02, are rejected.
+static int wt_day_from_date_str(char const *str, int32_t *day) {
+  int d, m, y;
+  char trailing;
+  if (sscanf(str, "%d/%d/%d%c", &d, &m, &y, &trailing) != 3) {
+    return -1;
+  }
+  if (m < 1 || m > 12 || d < 1 || d > wt_days_in_month(y, m)) {
+    return -1;
+  }
+  *day = wt_day_from_civil(y, m, d);
+  return 0;
+}
+
+static ssize_t wt_get_history(char const *history_file_path, int32_t **days,
                               struct wt_data **history) {
-  int res = 0;
+  ssize_t res = 0;
   FILE *f = fopen(history_file_path, "r");
   if (f == NULL) {
     res = -1;
@@ -370,43 +833,41 @@ static ssize_t wt_get_history(char const *history_file_path,
   ssize_t r;
   size_t history_length = 0;
   size_t history_capacity = 128;
+  *days = calloc(history_capacity, sizeof(**days));
   *history = calloc(history_capacity, sizeof(**history));
-  if (*history == NULL) {
+  if (*days == NULL || *history == NULL) {
     res = -1;
     goto cleanup;
   }
   while ((r = getline(&line, &length, f)) >= 0) {
+    char const *date;
     struct wt_data data;
-    char const *date = strtok(line, ",");
-    char const *data_str = strtok(NULL, ",");
-    if (data_str == NULL) {
-      continue;
-    }
-    data.weight_kg = wt_float_from_str(data_str);
-    data_str = strtok(NULL, ",");
-    if (data_str == NULL) {
-      continue;
-    }
-    data.body_fat_percent = wt_float_from_str(data_str);
-    data_str = strtok(NULL, ",");
-    if (data_str == NULL) {
+    int32_t day;
+    if (wt_data_from_csv_line(line, &date, &data) < 0) {
       continue;
     }
-    data.muscle_mass_percent = wt_float_from_str(data_str);
-    data_str = strtok(NULL, ",");
-    if (data_str == NULL) {
+    if (date == NULL || wt_day_from_date_str(date, &day) < 0) {
       continue;
     }
-    data.water_mass_percent = wt_float_from_str(data_str);
     if (history_length == history_capacity) {
       history_capacity *= 2;
-      *history = realloc(*history, history_capacity);
-      if (*history == NULL) {
+      int32_t *new_days = realloc(*days, history_capacity * sizeof(**days));
+      if (new_days == NULL) {
         res = -1;
         goto cleanup;
       }
+      *days = new_days;
+      struct wt_data *new_history =
+          realloc(*history, history_capacity * sizeof(**history));
+      if (new_history == NULL) {
+        res = -1;
+        goto cleanup;
+      }
+      *history = new_history;
     }
-    (*history)[history_length++] = data;
+    (*days)[history_length] = day;
+    (*history)[history_length] = data;
+    history_length++;
   }
   res = history_length;
 cleanup:
@@ -416,35 +877,1304 @@ exit:
   return res;
 }
 
-static void wt_free_history(struct wt_data **history) {
+static void wt_free_history(int32_t **days, struct wt_data **history) {
+  free(*days);
+  *days = NULL;
   free(*history);
   *history = NULL;
   return;
 }
 
-#define wt_data_increment(sum, data, attr)                                     \
-  if (!isnan(data.attr)) {                                                     \
-    sum.attr += data.attr;                                                     \
-    attr##_cnt++;                                                              \
+static int32_t wt_day_from_time(time_t unix_time) {
+  struct tm const *tm = localtime(&unix_time);
+  return wt_day_from_civil(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday);
+}
+
+static uint32_t wt_crc32(uint32_t crc, void const *data, size_t size) {
+  static uint32_t table[256];
+  if (table[1] == 0) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+  uint8_t const *bytes = data;
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
   }
+  return ~crc;
+}
 
-#define wt_data_norm(sum, attr)                                                \
-  if (attr##_cnt != 0) {                                                       \
-    sum.attr /= attr##_cnt;                                                    \
-  } else {                                                                     \
-    sum.attr = nanf("nan");                                                    \
+static int wt_write_all(int fd, void const *buff, size_t size) {
+  uint8_t const *bytes = buff;
+  while (size > 0) {
+    ssize_t const written = write(fd, bytes, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    bytes += written;
+    size -= written;
   }
+  return 0;
+}
 
-static ssize_t wt_moving_avg(size_t data_length,
-                             struct wt_data data[data_length],
-                             size_t avg_window_length,
-                             struct wt_data **data_avg) {
-  int res = 0;
-  if (data_length < avg_window_length) {
-    res = -1;
-    goto exit;
+/// Base file layout: the header, `profile_count` profile entries sorted by
+/// name, `block_count` block index entries, then `record_count` records. The
+/// blocks and records of a profile are contiguous, records are sorted by day
+/// and split in blocks of WT_STORE_BLOCK_RECORDS. `crc` covers the header,
+/// with `crc` set to 0.
+struct wt_store_header {
+  char magic[4];
+  uint32_t version;
+  uint64_t generation; ///< Of the last journal merged into this base.
+  uint32_t profile_count;
+  uint32_t block_count;
+  uint64_t record_count;
+  uint32_t crc;
+  uint32_t reserved;
+};
+
+/// Extents of a profile in the block index and in the records.
+struct wt_store_profile {
+  char name[WT_PROFILE_NAME_MAX_SIZE]; ///< Zero padded.
+  uint64_t first_record;
+  uint64_t record_count;
+  uint64_t first_block;
+  uint32_t index_crc; ///< Of the profile block index entries.
+  uint32_t crc;       ///< Of this entry, with `crc` set to 0.
+};
+
+struct wt_store_block {
+  int32_t first_day;
+  uint32_t crc; ///< Of the block records.
+};
+
+/// Journal layout: the header, then entries in log order. A journal whose
+/// generation is not newer than the base one has already been merged.
+struct wt_journal_header {
+  char magic[4];
+  uint32_t version;
+  uint64_t generation;
+};
+
+struct wt_journal_entry {
+  char profile[WT_PROFILE_NAME_MAX_SIZE]; ///< Zero padded.
+  struct wt_record record;
+  uint32_t crc; ///< Of `profile` and `record`.
+};
+
+/// Version 1 base file layout, holding a single series: the header,
+/// `block_count` block index entries, then `record_count` records sorted by
+/// day. `crc` covers the header, with `crc` set to 0, and the block index.
+/// Its journal has the same header, with version 1, and
+/// `wt_journal_entry_single` entries.
+struct wt_store_header_single {
+  char magic[4];
+  uint32_t version;
+  uint64_t generation;
+  uint64_t record_count;
+  uint32_t block_count;
+  uint32_t crc;
+};
+
+struct wt_journal_entry_single {
+  struct wt_record record;
+  uint32_t crc; ///< Of `record`.
+};
+
+static int wt_store_init(struct wt_store *self, char const *profile) {
+  char const *home = getenv("HOME");
+  if (home == NULL || profile[0] == '\0' ||
+      strlen(profile) >= WT_PROFILE_NAME_MAX_SIZE) {
+    return -1;
   }
-  *data_avg = calloc(data_length - avg_window_length + 1, sizeof(**data_avg));
+  memset(self->profile, 0, sizeof(self->profile));
+  strcpy(self->profile, profile);
+  if (snprintf(self->path, FILE_PATH_MAX_SIZE, "%s/%s", home,
+               WEIGHT_STORE_DEFAULT_FILE) >= FILE_PATH_MAX_SIZE ||
+      snprintf(self->journal_path, FILE_PATH_MAX_SIZE, "%s%s", self->path,
+               WT_JOURNAL_SUFFIX) >= FILE_PATH_MAX_SIZE ||
+      snprintf(self->legacy_path, FILE_PATH_MAX_SIZE, "%s/%s", home,
+               WEIGHT_HISTORY_DEFAULT_FILE) >= FILE_PATH_MAX_SIZE) {
+    return -1;
+  }
+  return 0;
+}
+
+static off_t wt_store_blocks_offset(struct wt_store_header const *header) {
+  return sizeof(*header) +
+         (off_t)header->profile_count * sizeof(struct wt_store_profile);
+}
+
+static off_t wt_store_records_offset(struct wt_store_header const *header) {
+  return wt_store_blocks_offset(header) +
+         (off_t)header->block_count * sizeof(struct wt_store_block);
+}
+
+/// Returns the version of the base file at `path`, 0 if it does not exist, or
+/// -1 on error.
+static int wt_store_version(char const *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return errno == ENOENT ? 0 : -1;
+  }
+  struct wt_store_header header;
+  ssize_t const r = pread(fd, &header, offsetof(struct wt_store_header,
+                                                generation), 0);
+  close(fd);
+  if (r != offsetof(struct wt_store_header, generation) ||
+      memcmp(header.magic, WT_STORE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version == 0) {
+    return -1;
+  }
+  return header.version;
+}
+
+static int wt_store_read_header(int fd, struct wt_store_header *header) {
+  if (pread(fd, header, sizeof(*header), 0) != sizeof(*header) ||
+      memcmp(header->magic, WT_STORE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != WT_STORE_VERSION) {
+    return -1;
+  }
+  struct wt_store_header unsealed = *header;
+  unsealed.crc = 0;
+  return wt_crc32(0, &unsealed, sizeof(unsealed)) == header->crc ? 0 : -1;
+}
+
+static int wt_store_read_profile(int fd, uint32_t i,
+                                 struct wt_store_profile *profile) {
+  off_t const offset =
+      sizeof(struct wt_store_header) + (off_t)i * sizeof(*profile);
+  if (pread(fd, profile, sizeof(*profile), offset) != sizeof(*profile)) {
+    return -1;
+  }
+  struct wt_store_profile unsealed = *profile;
+  unsealed.crc = 0;
+  return wt_crc32(0, &unsealed, sizeof(unsealed)) == profile->crc ? 0 : -1;
+}
+
+/// Binary searches the profile index for `name`. Returns 1 if found, 0 if not.
+static int wt_store_find_profile(int fd, struct wt_store_header const *header,
+                                 char const *name,
+                                 struct wt_store_profile *profile) {
+  uint32_t lo = 0;
+  uint32_t hi = header->profile_count;
+  while (lo < hi) {
+    uint32_t const mid = lo + (hi - lo) / 2;
+    if (wt_store_read_profile(fd, mid, profile) < 0) {
+      return -1;
+    }
+    int const cmp = strncmp(name, profile->name, WT_PROFILE_NAME_MAX_SIZE);
+    if (cmp == 0) {
+      return 1;
+    }
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return 0;
+}
+
+static uint32_t wt_store_profile_block_count(
+    struct wt_store_profile const *profile) {
+  return (profile->record_count + WT_STORE_BLOCK_RECORDS - 1) /
+         WT_STORE_BLOCK_RECORDS;
+}
+
+/// Reads and validates the block index of `profile`. `*blocks` must be freed
+/// by the caller.
+static int wt_store_read_index(int fd, struct wt_store_header const *header,
+                               struct wt_store_profile const *profile,
+                               struct wt_store_block **blocks) {
+  uint32_t const block_count = wt_store_profile_block_count(profile);
+  size_t const index_size = block_count * sizeof(**blocks);
+  off_t const offset = wt_store_blocks_offset(header) +
+                       (off_t)profile->first_block * sizeof(**blocks);
+  *blocks = calloc(block_count + 1, sizeof(**blocks));
+  if (*blocks == NULL ||
+      profile->first_block + block_count > header->block_count ||
+      profile->first_record + profile->record_count > header->record_count ||
+      pread(fd, *blocks, index_size, offset) != (ssize_t)index_size ||
+      wt_crc32(0, *blocks, index_size) != profile->index_crc) {
+    free(*blocks);
+    *blocks = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+/// Reads the `b`-th block of `profile` into `records`, returning its length.
+static ssize_t wt_store_read_block(
+    int fd, struct wt_store_header const *header,
+    struct wt_store_profile const *profile,
+    struct wt_store_block const blocks[], uint32_t b,
+    struct wt_record records[WT_STORE_BLOCK_RECORDS]) {
+  uint64_t const first = (uint64_t)b * WT_STORE_BLOCK_RECORDS;
+  size_t const length = profile->record_count - first < WT_STORE_BLOCK_RECORDS
+                            ? profile->record_count - first
+                            : WT_STORE_BLOCK_RECORDS;
+  size_t const size = length * sizeof(*records);
+  off_t const offset = wt_store_records_offset(header) +
+                       (profile->first_record + first) * sizeof(*records);
+  if (pread(fd, records, size, offset) != (ssize_t)size ||
+      wt_crc32(0, records, size) != blocks[b].crc) {
+    return -1;
+  }
+  return length;
+}
+
+struct wt_record_list {
+  size_t length;
+  size_t capacity;
+  struct wt_record *records;
+};
+
+static int wt_record_list_push(void *ctx, struct wt_record const *record) {
+  struct wt_record_list *self = ctx;
+  if (self->length == self->capacity) {
+    size_t const capacity = self->capacity == 0 ? 128 : 2 * self->capacity;
+    struct wt_record *records =
+        realloc(self->records, capacity * sizeof(*records));
+    if (records == NULL) {
+      return -1;
+    }
+    self->records = records;
+    self->capacity = capacity;
+  }
+  self->records[self->length++] = *record;
+  return 0;
+}
+
+static void wt_record_list_free(struct wt_record_list *self) {
+  free(self->records);
+  memset(self, 0, sizeof(*self));
+}
+
+struct wt_day_order {
+  int32_t day;
+  size_t index;
+};
+
+static int wt_day_order_cmp(void const *a, void const *b) {
+  struct wt_day_order const *lhs = a;
+  struct wt_day_order const *rhs = b;
+  if (lhs->day != rhs->day) {
+    return lhs->day < rhs->day ? -1 : 1;
+  }
+  return (lhs->index > rhs->index) - (lhs->index < rhs->index);
+}
+
+/// Sorts `self` by day, keeping the log order of records of the same day.
+static int wt_record_list_sort(struct wt_record_list *self) {
+  struct wt_day_order *order = calloc(self->length + 1, sizeof(*order));
+  struct wt_record *records = calloc(self->length + 1, sizeof(*records));
+  if (order == NULL || records == NULL) {
+    free(order);
+    free(records);
+    return -1;
+  }
+  for (size_t i = 0; i < self->length; i++) {
+    order[i].day = self->records[i].day;
+    order[i].index = i;
+  }
+  qsort(order, self->length, sizeof(*order), wt_day_order_cmp);
+  for (size_t i = 0; i < self->length; i++) {
+    records[i] = self->records[order[i].index];
+  }
+  free(order);
+  free(self->records);
+  self->records = records;
+  self->capacity = self->length + 1;
+  return 0;
+}
+
+typedef int (*wt_journal_visitor)(void *ctx,
+                                  struct wt_journal_entry const *entry);
+
+/// Visits the journal entries not merged yet into a base of `base_generation`,
+/// stopping at the first torn or corrupted entry. `visit` may be NULL to only
+/// validate the entries. `*generation` is set to the generation of the newest
+/// data between the base and the journal. Returns the offset past the last
+/// valid entry, 0 if the journal is stale or missing, or -1 on error.
+static off_t wt_journal_load(int fd, uint64_t base_generation,
+                             wt_journal_visitor visit, void *ctx,
+                             uint64_t *generation) {
+  *generation = base_generation;
+  struct wt_journal_header header;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, WT_JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != WT_JOURNAL_VERSION ||
+      header.generation <= base_generation) {
+    return 0;
+  }
+  *generation = header.generation;
+  struct wt_journal_entry entries[WT_STORE_BLOCK_RECORDS];
+  off_t offset = sizeof(header);
+  ssize_t r;
+  while ((r = pread(fd, entries, sizeof(entries), offset)) > 0) {
+    size_t const length = r / sizeof(*entries);
+    for (size_t i = 0; i < length; i++) {
+      if (wt_crc32(0, &entries[i], offsetof(struct wt_journal_entry, crc)) !=
+          entries[i].crc) {
+        return offset + i * sizeof(*entries);
+      }
+      if (visit != NULL && visit(ctx, &entries[i]) < 0) {
+        return -1;
+      }
+    }
+    offset += length * sizeof(*entries);
+    if (length < WT_STORE_BLOCK_RECORDS) {
+      break;
+    }
+  }
+  return r < 0 ? -1 : offset;
+}
+
+struct wt_profile_filter {
+  char const *profile;
+  struct wt_record_list *records;
+};
+
+static int wt_profile_filter_push(void *ctx,
+                                  struct wt_journal_entry const *entry) {
+  struct wt_profile_filter const *self = ctx;
+  if (strncmp(entry->profile, self->profile, WT_PROFILE_NAME_MAX_SIZE) != 0) {
+    return 0;
+  }
+  return wt_record_list_push(self->records, &entry->record);
+}
+
+typedef int (*wt_record_visitor)(void *ctx, struct wt_record const *record);
+
+/// Visits in day order the base and journal records of the store profile
+/// within [from_day, to_day]. Journal records follow base records of the same
+/// day. The profile is located by binary search of the profile index, and
+/// only its blocks overlapping the range are read. The caller holds a lock
+/// on `journal_fd`.
+static int wt_store_merge_scan(struct wt_store const *self, int journal_fd,
+                               int32_t from_day, int32_t to_day,
+                               wt_record_visitor visit, void *ctx) {
+  int res = 0;
+  struct wt_store_header header = {0};
+  struct wt_store_profile profile = {0};
+  struct wt_store_block *blocks = NULL;
+  struct wt_record_list journal = {0};
+  int fd = open(self->path, O_RDONLY);
+  if (fd < 0 && errno != ENOENT) {
+    res = -1;
+    goto exit;
+  }
+  if (fd >= 0) {
+    int found;
+    if (wt_store_read_header(fd, &header) < 0 ||
+        (found = wt_store_find_profile(fd, &header, self->profile, &profile)) <
+            0 ||
+        (found && wt_store_read_index(fd, &header, &profile, &blocks) < 0)) {
+      res = -1;
+      goto cleanup;
+    }
+    if (!found) {
+      profile.record_count = 0;
+    }
+  }
+  uint64_t generation;
+  struct wt_profile_filter filter = {.profile = self->profile,
+                                     .records = &journal};
+  if (wt_journal_load(journal_fd, header.generation, wt_profile_filter_push,
+                      &filter, &generation) < 0 ||
+      wt_record_list_sort(&journal) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  size_t j = 0;
+  while (j < journal.length && journal.records[j].day < from_day) {
+    j++;
+  }
+  uint32_t const block_count = wt_store_profile_block_count(&profile);
+  uint32_t lo = 0;
+  uint32_t hi = block_count;
+  while (lo < hi) {
+    uint32_t const mid = lo + (hi - lo) / 2;
+    if (blocks[mid].first_day < from_day) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  struct wt_record block_records[WT_STORE_BLOCK_RECORDS];
+  bool done = false;
+  for (uint32_t b = lo > 0 ? lo - 1 : 0; b < block_count && !done; b++) {
+    ssize_t const length = wt_store_read_block(fd, &header, &profile, blocks,
+                                               b, block_records);
+    if (length < 0) {
+      res = -1;
+      goto cleanup;
+    }
+    for (ssize_t i = 0; i < length; i++) {
+      struct wt_record const *record = &block_records[i];
+      if (record->day < from_day) {
+        continue;
+      }
+      if (record->day > to_day) {
+        done = true;
+        break;
+      }
+      for (; j < journal.length && journal.records[j].day < record->day; j++) {
+        if (visit(ctx, &journal.records[j]) < 0) {
+          res = -1;
+          goto cleanup;
+        }
+      }
+      if (visit(ctx, record) < 0) {
+        res = -1;
+        goto cleanup;
+      }
+    }
+  }
+  for (; j < journal.length && journal.records[j].day <= to_day; j++) {
+    if (visit(ctx, &journal.records[j]) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  }
+cleanup:
+  if (fd >= 0) {
+    close(fd);
+  }
+  free(blocks);
+  wt_record_list_free(&journal);
+exit:
+  return res;
+}
+
+/// Empties the journal in place and restarts it at `generation`. Keeping the
+/// same inode keeps the lock held on `fd` meaningful to the other processes.
+/// If interrupted, an empty or truncated journal only holds merged entries.
+static int wt_journal_reset(int fd, uint64_t generation) {
+  struct wt_journal_header header = {.magic = WT_JOURNAL_MAGIC,
+                                     .version = WT_JOURNAL_VERSION,
+                                     .generation = generation};
+  if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0 ||
+      wt_write_all(fd, &header, sizeof(header)) < 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/// Opens the journal, creating it if needed, and locks it with `operation`
+/// (LOCK_SH or LOCK_EX). The lock is released by closing the descriptor.
+static int wt_journal_open_locked(struct wt_store const *self, int flags,
+                                  int operation) {
+  int fd = open(self->journal_path, flags | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return -1;
+  }
+  while (flock(fd, operation) < 0) {
+    if (errno != EINTR) {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+struct wt_profile_records {
+  char name[WT_PROFILE_NAME_MAX_SIZE]; ///< Zero padded.
+  struct wt_record_list records;
+};
+
+/// Profiles sorted by name, as in the base profile index.
+struct wt_profile_table {
+  size_t length;
+  size_t capacity;
+  struct wt_profile_records *profiles;
+};
+
+/// Finds the position of `name` in `self`, or where it would be inserted.
+static size_t wt_profile_table_lower_bound(struct wt_profile_table const *self,
+                                           char const *name, bool *found) {
+  size_t lo = 0;
+  size_t hi = self->length;
+  *found = false;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    int const cmp =
+        strncmp(name, self->profiles[mid].name, WT_PROFILE_NAME_MAX_SIZE);
+    if (cmp == 0) {
+      *found = true;
+      return mid;
+    }
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+/// Returns the records of profile `name`, adding the profile if needed.
+static struct wt_record_list *
+wt_profile_table_get(struct wt_profile_table *self, char const *name) {
+  bool found;
+  size_t const i = wt_profile_table_lower_bound(self, name, &found);
+  if (found) {
+    return &self->profiles[i].records;
+  }
+  if (self->length == self->capacity) {
+    size_t const capacity = self->capacity == 0 ? 16 : 2 * self->capacity;
+    struct wt_profile_records *profiles =
+        realloc(self->profiles, capacity * sizeof(*profiles));
+    if (profiles == NULL) {
+      return NULL;
+    }
+    self->profiles = profiles;
+    self->capacity = capacity;
+  }
+  memmove(&self->profiles[i + 1], &self->profiles[i],
+          (self->length - i) * sizeof(*self->profiles));
+  self->length++;
+  memset(&self->profiles[i], 0, sizeof(*self->profiles));
+  strncpy(self->profiles[i].name, name, WT_PROFILE_NAME_MAX_SIZE - 1);
+  return &self->profiles[i].records;
+}
+
+/// Returns the records of profile `name`, or NULL if it is not in `self`.
+static struct wt_record_list *
+wt_profile_table_find(struct wt_profile_table *self, char const *name) {
+  bool found;
+  size_t const i = wt_profile_table_lower_bound(self, name, &found);
+  return found ? &self->profiles[i].records : NULL;
+}
+
+static void wt_profile_table_free(struct wt_profile_table *self) {
+  for (size_t i = 0; i < self->length; i++) {
+    wt_record_list_free(&self->profiles[i].records);
+  }
+  free(self->profiles);
+  memset(self, 0, sizeof(*self));
+}
+
+static int wt_profile_table_push(void *ctx,
+                                 struct wt_journal_entry const *entry) {
+  struct wt_record_list *records = wt_profile_table_get(ctx, entry->profile);
+  if (records == NULL) {
+    return -1;
+  }
+  return wt_record_list_push(records, &entry->record);
+}
+
+/// Puts the records of `self` after `older`, which is consumed, so that a
+/// stable sort keeps the older records first within a day.
+static int wt_record_list_prepend(struct wt_record_list *self,
+                                  struct wt_record_list *older) {
+  for (size_t i = 0; i < self->length; i++) {
+    if (wt_record_list_push(older, &self->records[i]) < 0) {
+      wt_record_list_free(older);
+      return -1;
+    }
+  }
+  wt_record_list_free(self);
+  *self = *older;
+  memset(older, 0, sizeof(*older));
+  return 0;
+}
+
+/// Loads the records of `profile` from the base file at `fd` into `records`.
+static int wt_store_load_profile(int fd, struct wt_store_header const *header,
+                                 struct wt_store_profile const *profile,
+                                 struct wt_record_list *records) {
+  struct wt_record block_records[WT_STORE_BLOCK_RECORDS];
+  struct wt_store_block *blocks = NULL;
+  if (wt_store_read_index(fd, header, profile, &blocks) < 0) {
+    return -1;
+  }
+  int res = 0;
+  uint32_t const block_count = wt_store_profile_block_count(profile);
+  for (uint32_t b = 0; res == 0 && b < block_count; b++) {
+    ssize_t const length =
+        wt_store_read_block(fd, header, profile, blocks, b, block_records);
+    res = length < 0 ? -1 : 0;
+    for (ssize_t i = 0; res == 0 && i < length; i++) {
+      res = wt_record_list_push(records, &block_records[i]);
+    }
+  }
+  free(blocks);
+  return res;
+}
+
+/// Loads the records of the version 1 base file at `fd`, then the entries of
+/// its version 1 journal not merged yet, into `records`. `*generation` is set
+/// as `wt_journal_load` does.
+static int wt_store_load_single(int fd, int journal_fd,
+                                struct wt_record_list *records,
+                                uint64_t *generation) {
+  int res = 0;
+  struct wt_store_header_single header;
+  struct wt_store_block *blocks = NULL;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, WT_STORE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != WT_STORE_VERSION_SINGLE ||
+      header.block_count !=
+          (header.record_count + WT_STORE_BLOCK_RECORDS - 1) /
+              WT_STORE_BLOCK_RECORDS) {
+    res = -1;
+    goto exit;
+  }
+  size_t const index_size = header.block_count * sizeof(*blocks);
+  blocks = calloc(header.block_count + 1, sizeof(*blocks));
+  if (blocks == NULL || pread(fd, blocks, index_size, sizeof(header)) !=
+                            (ssize_t)index_size) {
+    res = -1;
+    goto cleanup;
+  }
+  struct wt_store_header_single unsealed = header;
+  unsealed.crc = 0;
+  if (wt_crc32(wt_crc32(0, &unsealed, sizeof(unsealed)), blocks,
+               index_size) != header.crc) {
+    res = -1;
+    goto cleanup;
+  }
+  struct wt_record block_records[WT_STORE_BLOCK_RECORDS];
+  for (uint32_t b = 0; b < header.block_count; b++) {
+    uint64_t const first = (uint64_t)b * WT_STORE_BLOCK_RECORDS;
+    size_t const length = header.record_count - first < WT_STORE_BLOCK_RECORDS
+                              ? header.record_count - first
+                              : WT_STORE_BLOCK_RECORDS;
+    size_t const size = length * sizeof(*block_records);
+    off_t const offset =
+        sizeof(header) + index_size + first * sizeof(*block_records);
+    if (pread(fd, block_records, size, offset) != (ssize_t)size ||
+        wt_crc32(0, block_records, size) != blocks[b].crc) {
+      res = -1;
+      goto cleanup;
+    }
+    for (size_t i = 0; i < length; i++) {
+      if (wt_record_list_push(records, &block_records[i]) < 0) {
+        res = -1;
+        goto cleanup;
+      }
+    }
+  }
+  *generation = header.generation;
+  struct wt_journal_header journal_header;
+  if (pread(journal_fd, &journal_header, sizeof(journal_header), 0) !=
+          sizeof(journal_header) ||
+      memcmp(journal_header.magic, WT_JOURNAL_MAGIC,
+             sizeof(journal_header.magic)) != 0 ||
+      journal_header.version != WT_STORE_VERSION_SINGLE ||
+      journal_header.generation <= header.generation) {
+    goto cleanup;
+  }
+  *generation = journal_header.generation;
+  struct wt_journal_entry_single entry;
+  for (off_t offset = sizeof(journal_header);
+       pread(journal_fd, &entry, sizeof(entry), offset) == sizeof(entry) &&
+       wt_crc32(0, &entry.record, sizeof(entry.record)) == entry.crc;
+       offset += sizeof(entry)) {
+    if (wt_record_list_push(records, &entry.record) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  }
+cleanup:
+  free(blocks);
+exit:
+  return res;
+}
+
+static int wt_copy_range(int dst_fd, int src_fd, off_t offset, uint64_t size) {
+  static uint8_t buff[64 * 1024];
+  while (size > 0) {
+    size_t const chunk = size < sizeof(buff) ? size : sizeof(buff);
+    ssize_t const r = pread(src_fd, buff, chunk, offset);
+    if (r <= 0 || wt_write_all(dst_fd, buff, r) < 0) {
+      return -1;
+    }
+    offset += r;
+    size -= r;
+  }
+  return 0;
+}
+
+/// A profile of the base being written. It is either copied unchanged from
+/// the previous base, from `source`, or rebuilt from `records`.
+struct wt_store_plan {
+  struct wt_store_profile profile;
+  struct wt_store_profile const *source;
+  struct wt_record_list const *records;
+};
+
+/// Writes a base file of `generation` to `fd`, holding the `unchanged`
+/// profiles of the previous base at `base_fd` and the profiles of `table`.
+/// Unchanged profiles are copied as raw bytes, reusing their block index and
+/// checksums. Only the profiles of `table` are split in blocks and checksummed.
+static int wt_store_write(int fd, int base_fd,
+                          struct wt_store_header const *base_header,
+                          size_t unchanged_length,
+                          struct wt_store_profile const unchanged[],
+                          struct wt_profile_table const *table,
+                          uint64_t generation) {
+  int res = 0;
+  size_t const length = unchanged_length + table->length;
+  struct wt_store_header header = {
+      .magic = WT_STORE_MAGIC,
+      .version = WT_STORE_VERSION,
+      .generation = generation,
+      .profile_count = length,
+  };
+  struct wt_store_plan *plans = calloc(length + 1, sizeof(*plans));
+  struct wt_store_profile *profiles = calloc(length + 1, sizeof(*profiles));
+  struct wt_store_block *blocks = NULL;
+  if (plans == NULL || profiles == NULL) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t p = 0, u = 0, t = 0; p < length; p++) {
+    struct wt_store_plan *plan = &plans[p];
+    if (t == table->length ||
+        (u < unchanged_length &&
+         strncmp(unchanged[u].name, table->profiles[t].name,
+                 WT_PROFILE_NAME_MAX_SIZE) < 0)) {
+      plan->source = &unchanged[u++];
+      plan->profile = *plan->source;
+    } else {
+      plan->records = &table->profiles[t].records;
+      memcpy(plan->profile.name, table->profiles[t].name,
+             sizeof(plan->profile.name));
+      plan->profile.record_count = plan->records->length;
+      t++;
+    }
+    plan->profile.first_record = header.record_count;
+    plan->profile.first_block = header.block_count;
+    header.record_count += plan->profile.record_count;
+    header.block_count += wt_store_profile_block_count(&plan->profile);
+  }
+  blocks = calloc(header.block_count + 1, sizeof(*blocks));
+  if (blocks == NULL) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t p = 0; p < length; p++) {
+    struct wt_store_plan *plan = &plans[p];
+    struct wt_store_block *profile_blocks = &blocks[plan->profile.first_block];
+    uint32_t const block_count = wt_store_profile_block_count(&plan->profile);
+    size_t const index_size = block_count * sizeof(*profile_blocks);
+    if (plan->source != NULL) {
+      off_t const offset =
+          wt_store_blocks_offset(base_header) +
+          (off_t)plan->source->first_block * sizeof(*profile_blocks);
+      if (pread(base_fd, profile_blocks, index_size, offset) !=
+          (ssize_t)index_size) {
+        res = -1;
+        goto cleanup;
+      }
+    } else {
+      struct wt_record_list const *records = plan->records;
+      for (uint32_t b = 0; b < block_count; b++) {
+        size_t const first = (size_t)b * WT_STORE_BLOCK_RECORDS;
+        size_t const count = records->length - first < WT_STORE_BLOCK_RECORDS
+                                 ? records->length - first
+                                 : WT_STORE_BLOCK_RECORDS;
+        profile_blocks[b].first_day = records->records[first].day;
+        profile_blocks[b].crc = wt_crc32(0, &records->records[first],
+                                         count * sizeof(*records->records));
+      }
+      plan->profile.index_crc = wt_crc32(0, profile_blocks, index_size);
+    }
+    plan->profile.crc = 0;
+    plan->profile.crc = wt_crc32(0, &plan->profile, sizeof(plan->profile));
+    profiles[p] = plan->profile;
+  }
+  header.crc = wt_crc32(0, &header, sizeof(header));
+  if (wt_write_all(fd, &header, sizeof(header)) < 0 ||
+      wt_write_all(fd, profiles, length * sizeof(*profiles)) < 0 ||
+      wt_write_all(fd, blocks, header.block_count * sizeof(*blocks)) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t p = 0; res == 0 && p < length; p++) {
+    struct wt_store_plan const *plan = &plans[p];
+    if (plan->records != NULL) {
+      res = wt_write_all(fd, plan->records->records,
+                         plan->records->length * sizeof(struct wt_record));
+      continue;
+    }
+    off_t const offset = wt_store_records_offset(base_header) +
+                         plan->source->first_record * sizeof(struct wt_record);
+    uint64_t size = plan->source->record_count * sizeof(struct wt_record);
+    for (; p + 1 < length && plans[p + 1].source != NULL &&
+           plans[p + 1].source->first_record ==
+               plans[p].source->first_record + plans[p].source->record_count;
+         p++) {
+      size += plans[p + 1].source->record_count * sizeof(struct wt_record);
+    }
+    res = wt_copy_range(fd, base_fd, offset, size);
+  }
+cleanup:
+  free(blocks);
+  free(profiles);
+  free(plans);
+  return res;
+}
+
+/// Merges the journal into a new sorted base file, swapped in with an atomic
+/// rename, then starts a new journal. Only the profiles with journal entries
+/// are loaded and sorted again, the others are copied unchanged. A missing
+/// base is seeded from the legacy CSV history, and a version 1 base and its
+/// journal are migrated, as the default profile. If
+/// interrupted before the journal is reset, the stale journal is recognized by
+/// its generation and ignored. A corrupted entry followed by more data fails
+/// the compaction rather than dropping what follows it. The caller holds an
+/// exclusive lock on `journal_fd` for the whole compaction.
+static int wt_store_compact_locked(struct wt_store const *self,
+                                   int journal_fd) {
+  int res = 0;
+  struct wt_profile_table table = {0};
+  struct wt_store_header header = {0};
+  struct wt_store_profile *unchanged = NULL;
+  size_t unchanged_length = 0;
+  char tmp_path[FILE_PATH_MAX_SIZE + 8];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", self->path);
+  bool tmp_created = false;
+  int fd = -1;
+  int base_fd = open(self->path, O_RDONLY);
+  if (base_fd < 0 && errno != ENOENT) {
+    res = -1;
+    goto cleanup;
+  }
+  bool single = false;
+  if (base_fd >= 0) {
+    single = wt_store_version(self->path) == WT_STORE_VERSION_SINGLE;
+    if (!single && wt_store_read_header(base_fd, &header) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  }
+  uint64_t generation;
+  struct stat st;
+  off_t const end = wt_journal_load(journal_fd, header.generation,
+                                    wt_profile_table_push, &table, &generation);
+  if (end < 0 || fstat(journal_fd, &st) < 0 ||
+      (end > 0 && end + (off_t)sizeof(struct wt_journal_entry) <= st.st_size)) {
+    res = -1;
+    goto cleanup;
+  }
+  if (base_fd >= 0 && !single && table.length == 0) {
+    res = wt_journal_reset(journal_fd, generation + 1);
+    goto cleanup;
+  }
+  if (single) {
+    struct wt_record_list series = {0};
+    struct wt_record_list *records =
+        wt_profile_table_get(&table, WT_PROFILE_DEFAULT);
+    if (records == NULL ||
+        wt_store_load_single(base_fd, journal_fd, &series, &generation) < 0 ||
+        wt_record_list_prepend(records, &series) < 0) {
+      wt_record_list_free(&series);
+      res = -1;
+      goto cleanup;
+    }
+  } else if (base_fd >= 0) {
+    unchanged = calloc(header.profile_count + 1, sizeof(*unchanged));
+    if (unchanged == NULL) {
+      res = -1;
+      goto cleanup;
+    }
+    for (uint32_t p = 0; p < header.profile_count; p++) {
+      struct wt_store_profile profile;
+      if (wt_store_read_profile(base_fd, p, &profile) < 0) {
+        res = -1;
+        goto cleanup;
+      }
+      struct wt_record_list *records =
+          wt_profile_table_find(&table, profile.name);
+      if (records == NULL) {
+        unchanged[unchanged_length++] = profile;
+        continue;
+      }
+      struct wt_record_list base_records = {0};
+      if (wt_store_load_profile(base_fd, &header, &profile, &base_records) <
+              0 ||
+          wt_record_list_prepend(records, &base_records) < 0) {
+        wt_record_list_free(&base_records);
+        res = -1;
+        goto cleanup;
+      }
+    }
+  } else if (access(self->legacy_path, F_OK) == 0) {
+    int32_t *days = NULL;
+    struct wt_data *history = NULL;
+    struct wt_record_list legacy = {0};
+    ssize_t const history_length =
+        wt_get_history(self->legacy_path, &days, &history);
+    for (ssize_t i = 0; i < history_length && res == 0; i++) {
+      struct wt_record const record = {.day = days[i], .data = history[i]};
+      res = wt_record_list_push(&legacy, &record);
+    }
+    wt_free_history(&days, &history);
+    struct wt_record_list *records =
+        wt_profile_table_get(&table, WT_PROFILE_DEFAULT);
+    if (history_length < 0 || res < 0 || records == NULL ||
+        wt_record_list_prepend(records, &legacy) < 0) {
+      wt_record_list_free(&legacy);
+      res = -1;
+      goto cleanup;
+    }
+  }
+  for (size_t p = 0; p < table.length; p++) {
+    if (wt_record_list_sort(&table.profiles[p].records) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  }
+  fd = mkstemp(tmp_path);
+  if (fd < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  tmp_created = true;
+  if (wt_store_write(fd, base_fd, &header, unchanged_length, unchanged, &table,
+                     generation) < 0 ||
+      fsync(fd) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  res = close(fd);
+  fd = -1;
+  if (res < 0 || rename(tmp_path, self->path) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  tmp_created = false;
+  res = wt_journal_reset(journal_fd, generation + 1);
+cleanup:
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (tmp_created) {
+    unlink(tmp_path);
+  }
+  if (base_fd >= 0) {
+    close(base_fd);
+  }
+  free(unchanged);
+  wt_profile_table_free(&table);
+  return res;
+}
+
+static int wt_store_compact(struct wt_store const *self) {
+  int fd = wt_journal_open_locked(self, O_RDWR, LOCK_EX);
+  if (fd < 0) {
+    return -1;
+  }
+  int const res = wt_store_compact_locked(self, fd);
+  close(fd);
+  return res;
+}
+
+/// Like `wt_store_merge_scan`, holding a shared lock on the journal so that no
+/// compaction runs meanwhile. A missing or version 1 base is first compacted,
+/// so that the legacy CSV history or the single series store is imported.
+static int wt_store_scan(struct wt_store const *self, int32_t from_day,
+                         int32_t to_day, wt_record_visitor visit, void *ctx) {
+  int const version = wt_store_version(self->path);
+  if (version < 0 ||
+      (version < WT_STORE_VERSION && wt_store_compact(self) < 0)) {
+    return -1;
+  }
+  int fd = wt_journal_open_locked(self, O_RDONLY, LOCK_SH);
+  if (fd < 0) {
+    return -1;
+  }
+  int const res =
+      wt_store_merge_scan(self, fd, from_day, to_day, visit, ctx);
+  close(fd);
+  return res;
+}
+
+/// Runs `wt_store_compact_locked` in a child process that is not waited on, so
+/// that the caller returns without waiting for the rewrite. The child inherits
+/// `journal_fd`, and with it the lock, which is released once both processes
+/// have closed it. A failed compaction leaves the journal as it is, to be
+/// compacted again by the next append. Compaction runs inline if the child
+/// cannot be created.
+static int wt_store_compact_background(struct wt_store const *self,
+                                       int journal_fd) {
+  pid_t const pid = fork();
+  if (pid < 0) {
+    return wt_store_compact_locked(self, journal_fd);
+  }
+  if (pid == 0) {
+    int const res = wt_store_compact_locked(self, journal_fd);
+    _exit(res < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+  return 0;
+}
+
+/// Appends `record` to the journal, compacting it into the base once it grows
+/// past WT_JOURNAL_COMPACT_THRESHOLD bytes, in the background. The journal
+/// stays exclusively locked from the generation check to the end of any
+/// compaction, so that concurrent appends are neither interleaved nor lost.
+/// The journal is first truncated after its last valid entry, so that a torn
+/// or corrupted tail left by a crash does not hide the new entry from the
+/// readers.
+static int wt_store_append(struct wt_store const *self,
+                           struct wt_record const *record) {
+  int res = 0;
+  off_t size = 0;
+  int journal_fd = wt_journal_open_locked(self, O_RDWR | O_APPEND, LOCK_EX);
+  if (journal_fd < 0) {
+    res = -1;
+    goto exit;
+  }
+  int const version = wt_store_version(self->path);
+  if (version < 0 || (version < WT_STORE_VERSION &&
+                      wt_store_compact_locked(self, journal_fd) < 0)) {
+    res = -1;
+    goto cleanup;
+  }
+  int fd = open(self->path, O_RDONLY);
+  if (fd < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  struct wt_store_header header;
+  res = wt_store_read_header(fd, &header);
+  close(fd);
+  if (res < 0) {
+    goto cleanup;
+  }
+  uint64_t generation;
+  size = wt_journal_load(journal_fd, header.generation, NULL, NULL,
+                         &generation);
+  if (size < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  if (size == 0) {
+    size = sizeof(struct wt_journal_header);
+    if (wt_journal_reset(journal_fd, header.generation + 1) < 0) {
+      res = -1;
+      goto cleanup;
+    }
+  } else if (ftruncate(journal_fd, size) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  struct wt_journal_entry entry = {.record = *record};
+  memcpy(entry.profile, self->profile, sizeof(entry.profile));
+  entry.crc = wt_crc32(0, &entry, offsetof(struct wt_journal_entry, crc));
+  if (wt_write_all(journal_fd, &entry, sizeof(entry)) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  size += sizeof(entry);
+  if (size >= WT_JOURNAL_COMPACT_THRESHOLD) {
+    res = wt_store_compact_background(self, journal_fd);
+  }
+cleanup:
+  close(journal_fd);
+exit:
+  return res;
+}
+
+/// Loads the whole store history in day order, as `wt_get_history` does for
+/// CSV files.
+static ssize_t wt_store_get_history(struct wt_store const *self,
+                                    int32_t **days, struct wt_data **history) {
+  struct wt_record_list list = {0};
+  *days = NULL;
+  *history = NULL;
+  if (wt_store_scan(self, INT32_MIN, INT32_MAX, wt_record_list_push, &list) <
+      0) {
+    wt_record_list_free(&list);
+    return -1;
+  }
+  *days = calloc(list.length + 1, sizeof(**days));
+  *history = calloc(list.length + 1, sizeof(**history));
+  if (*days == NULL || *history == NULL) {
+    wt_record_list_free(&list);
+    wt_free_history(days, history);
+    return -1;
+  }
+  for (size_t i = 0; i < list.length; i++) {
+    (*days)[i] = list.records[i].day;
+    (*history)[i] = list.records[i].data;
+  }
+  ssize_t const res = list.length;
+  wt_record_list_free(&list);
+  return res;
+}
+
+static int log_weight(void const *args) {
+  struct wt_cmd_log_weight_args const *log_weight_args = args;
+  struct wt_record const record = {
+      .day = wt_day_from_time(time(NULL)),
+      .data =
+          {
+              .weight_kg = log_weight_args->weight,
+              .body_fat_percent = nanf("nan"),
+              .water_mass_percent = nanf("nan"),
+              .muscle_mass_percent = nanf("nan"),
+          },
+  };
+  return wt_store_append(&log_weight_args->store, &record);
+}
+
+static int log_data(void const *args) {
+  struct wt_cmd_log_data_args const *log_data_args = args;
+  struct wt_record const record = {
+      .day = wt_day_from_time(time(NULL)),
+      .data = log_data_args->data,
+  };
+  return wt_store_append(&log_data_args->store, &record);
+}
+
+static int compact(void const *args) {
+  struct wt_cmd_compact_args const *compact_args = args;
+  return wt_store_compact(&compact_args->store);
+}
+
+/// Averages the readings of `values` falling on the same grid day into `out`,
+/// leaving days without readings as NaN. `count` is scratch space.
+static void wt_resample_column(size_t length, int32_t const offset[length],
+                               float const values[length], size_t grid_length,
+                               float out[grid_length],
+                               uint32_t count[grid_length]) {
+  memset(out, 0, grid_length * sizeof(*out));
+  memset(count, 0, grid_length * sizeof(*count));
+  for (size_t i = 0; i < length; i++) {
+    if (isnan(values[i])) {
+      continue;
+    }
+    out[offset[i]] += values[i];
+    count[offset[i]]++;
+  }
+  for (size_t j = 0; j < grid_length; j++) {
+    out[j] = count[j] != 0 ? out[j] / count[j] : nanf("nan");
+  }
+}
+
+/// Linearly interpolates the NaN runs of `column` enclosed by known values.
+/// Leading and trailing runs are left untouched.
+static void wt_fill_column(size_t grid_length, float column[grid_length]) {
+  size_t prev = grid_length;
+  for (size_t j = 0; j < grid_length; j++) {
+    if (isnan(column[j])) {
+      continue;
+    }
+    if (prev != grid_length && j - prev > 1) {
+      float const step = (column[j] - column[prev]) / (float)(j - prev);
+      for (size_t k = prev + 1; k < j; k++) {
+        column[k] = column[prev] + step * (float)(k - prev);
+      }
+    }
+    prev = j;
+  }
+}
+
+#define wt_resample_attr(attr)                                                 \
+  for (size_t i = 0; i < data_length; i++) {                                   \
+    values[i] = data[i].attr;                                                  \
+  }                                                                            \
+  wt_resample_column(data_length, offset, values, grid_length, column, count); \
+  if (fill_gaps) {                                                             \
+    wt_fill_column(grid_length, column);                                       \
+  }                                                                            \
+  for (size_t j = 0; j < grid_length; j++) {                                   \
+    (*resampled)[j].attr = column[j];                                          \
+  }
+
+/// Aligns `data` to a dense calendar-day grid spanning from its first to its
+/// last day: readings of the same day are averaged and, if `fill_gaps` is set,
+/// missing days are linearly interpolated. Otherwise they are NaN.
+static ssize_t wt_resample_daily(size_t data_length,
+                                 int32_t const days[data_length],
+                                 struct wt_data const data[data_length],
+                                 bool fill_gaps, struct wt_data **resampled) {
+  ssize_t res = 0;
+  *resampled = NULL;
+  int32_t *offset = NULL;
+  float *values = NULL;
+  float *column = NULL;
+  uint32_t *count = NULL;
+  if (data_length == 0) {
+    res = 0;
+    goto exit;
+  }
+  int32_t first_day = days[0];
+  int32_t last_day = days[0];
+  for (size_t i = 1; i < data_length; i++) {
+    first_day = days[i] < first_day ? days[i] : first_day;
+    last_day = days[i] > last_day ? days[i] : last_day;
+  }
+  if ((int64_t)last_day - first_day >= WT_RESAMPLE_MAX_DAYS) {
+    res = -1;
+    goto exit;
+  }
+  size_t const grid_length = (size_t)(last_day - first_day) + 1;
+  offset = calloc(data_length, sizeof(*offset));
+  values = calloc(data_length, sizeof(*values));
+  column = calloc(grid_length, sizeof(*column));
+  count = calloc(grid_length, sizeof(*count));
+  *resampled = calloc(grid_length, sizeof(**resampled));
+  if (offset == NULL || values == NULL || column == NULL || count == NULL ||
+      *resampled == NULL) {
+    free(*resampled);
+    *resampled = NULL;
+    res = -1;
+    goto exit;
+  }
+  for (size_t i = 0; i < data_length; i++) {
+    offset[i] = days[i] - first_day;
+  }
+  wt_resample_attr(weight_kg);
+  wt_resample_attr(body_fat_percent);
+  wt_resample_attr(muscle_mass_percent);
+  wt_resample_attr(water_mass_percent);
+  res = grid_length;
+exit:
+  free(offset);
+  free(values);
+  free(column);
+  free(count);
+  return res;
+}
+#undef wt_resample_attr
+
+#define wt_data_increment(sum, data, attr)                                     \
+  if (!isnan(data.attr)) {                                                     \
+    sum.attr += data.attr;                                                     \
+    attr##_cnt++;                                                              \
+  }
+
+#define wt_data_norm(sum, attr)                                                \
+  if (attr##_cnt != 0) {                                                       \
+    sum.attr /= attr##_cnt;                                                    \
+  } else {                                                                     \
+    sum.attr = nanf("nan");                                                    \
+  }
+
+static ssize_t wt_moving_avg(size_t data_length,
+                             struct wt_data data[data_length],
+                             size_t avg_window_length,
+                             struct wt_data **data_avg) {
+  int res = 0;
+  if (data_length < avg_window_length) {
+    res = -1;
+    goto exit;
+  }
+  *data_avg = calloc(data_length - avg_window_length + 1, sizeof(**data_avg));
   if (data_avg == NULL) {
     res = -1;
     goto exit;
@@ -481,11 +2211,28 @@ static void wt_free_moving_avg(struct wt_data **data) {
   return;
 }
 
+/// Loads the store history resampled to one entry per calendar day.
+static ssize_t wt_get_daily_history(struct wt_store const *store,
+                                    bool fill_gaps, struct wt_data **daily) {
+  int32_t *days = NULL;
+  struct wt_data *history = NULL;
+  ssize_t history_length = wt_store_get_history(store, &days, &history);
+  if (history_length < 0) {
+    wt_free_history(&days, &history);
+    return -1;
+  }
+  ssize_t res =
+      wt_resample_daily(history_length, days, history, fill_gaps, daily);
+  wt_free_history(&days, &history);
+  return res;
+}
+
 static int avg(void const *args) {
   int res = 0;
   struct wt_cmd_avg_args const *avg_args = args;
   struct wt_data *history = NULL;
-  ssize_t history_length = wt_get_history(avg_args->file_path, &history);
+  ssize_t history_length =
+      wt_get_daily_history(&avg_args->store, avg_args->fill_gaps, &history);
   if (history_length < 0) {
     res = -1;
     goto exit;
@@ -506,7 +2253,7 @@ static int avg(void const *args) {
   }
   printf("===\n");
 cleanup:
-  wt_free_history(&history);
+  free(history);
   wt_free_moving_avg(&history_avg);
 exit:
   return res;
@@ -515,8 +2262,10 @@ exit:
 static int stats(void const *args) {
   int res = 0;
   struct wt_cmd_stats_args const *stats_args = args;
-  struct wt_data *history;
-  ssize_t history_length = wt_get_history(stats_args->file_path, &history);
+  struct wt_data *history = NULL;
+  struct wt_data *history_avg = NULL;
+  ssize_t history_length = wt_get_daily_history(
+      &stats_args->store, stats_args->fill_gaps, &history);
   if (history_length < 0) {
     res = -1;
     goto exit;
@@ -524,9 +2273,8 @@ static int stats(void const *args) {
   if (history_length < stats_args->avg_window_days) {
     printf("Not enough data to show stats.\n");
     res = 0;
-    goto exit;
+    goto cleanup;
   }
-  struct wt_data *history_avg = NULL;
   ssize_t history_avg_length = wt_moving_avg(
       history_length, history, stats_args->avg_window_days, &history_avg);
   if (history_avg_length < 0) {
@@ -541,18 +2289,42 @@ static int stats(void const *args) {
   wt_stats_print(&stats);
   res = 0;
 cleanup:
-  wt_free_history(&history);
+  free(history);
   wt_free_moving_avg(&history_avg);
-  free(history_avg);
 exit:
   return res;
 }
 
+struct wt_show_format {
+  int float_precision;
+  int min_width;
+};
+
+static int wt_show_visit(void *ctx, struct wt_record const *record) {
+  struct wt_show_format const *format = ctx;
+  char date[32];
+  wt_date_str_from_day(record->day, sizeof(date), date);
+  printf("|%-*7$s|%*7$.*6$f|%*7$.*6$f|%*7$.*6$f|%*7$.*6$f|\n", date,
+         record->data.weight_kg, record->data.body_fat_percent,
+         record->data.muscle_mass_percent, record->data.water_mass_percent,
+         format->float_precision, format->min_width);
+  return 0;
+}
+
 static int show(void const *args) {
   static int const float_precision = 2;
   static int const min_width = 15;
   int res = 0;
   struct wt_cmd_show_args const *show_args = args;
+  if (show_args->file_path[0] == '\0') {
+    printf("|%*6$s|%*6$s|%*6$s|%*6$s|%*6$s|\n", "day", "weight(kg)",
+           "body_fat(%)", "muscle_mass(%)", "water_mass(%)", -min_width);
+    struct wt_show_format format = {.float_precision = float_precision,
+                                    .min_width = min_width};
+    res = wt_store_scan(&show_args->store, show_args->from_day,
+                        show_args->to_day, wt_show_visit, &format);
+    goto exit;
+  }
   FILE *f = fopen(show_args->file_path, "r");
   if (f == NULL) {
     res = -1;
@@ -592,8 +2364,136 @@ exit:
   return res;
 }
 
+static int wt_dist_visit(void *ctx, struct wt_record const *record) {
+  return wt_dist_update(ctx, record->day, &record->data);
+}
+
+static int dist(void const *args) {
+  int res = 0;
+  struct wt_cmd_dist_args const *dist_args = args;
+  struct wt_dist dist;
+  wt_dist_init(&dist, dist_args->window_days);
+  char *line = NULL;
+  size_t length = 0;
+  char *const *inputs = dist_args->inputs;
+  if (dist_args->input_count == 0 &&
+      wt_store_scan(&dist_args->store, dist_args->from_day, dist_args->to_day,
+                    wt_dist_visit, &dist) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t i = 0; i < dist_args->input_count; i++) {
+    if (dist_args->merge) {
+      if (wt_dist_merge_file(&dist, inputs[i]) < 0) {
+        fprintf(stderr, "cannot merge sketches from %s\n", inputs[i]);
+        res = -1;
+        goto cleanup;
+      }
+      continue;
+    }
+    FILE *f = fopen(inputs[i], "r");
+    if (f == NULL) {
+      fprintf(stderr, "cannot open %s\n", inputs[i]);
+      res = -1;
+      goto cleanup;
+    }
+    while (getline(&line, &length, f) >= 0) {
+      char const *date;
+      struct wt_data data;
+      int32_t day;
+      if (wt_data_from_csv_line(line, &date, &data) < 0 || date == NULL ||
+          wt_day_from_date_str(date, &day) < 0 ||
+          day < dist_args->from_day || day > dist_args->to_day) {
+        continue;
+      }
+      if (wt_dist_update(&dist, day, &data) < 0) {
+        res = -1;
+        break;
+      }
+    }
+    fclose(f);
+    if (res < 0) {
+      goto cleanup;
+    }
+  }
+  if (dist_args->save_path[0] != '\0' &&
+      wt_dist_write(&dist, dist_args->save_path) < 0) {
+    res = -1;
+    goto cleanup;
+  }
+  for (size_t i = 0; i < dist.length; i++) {
+    struct wt_dist_window const *window = dist.windows[i];
+    if (dist.window_days == 0) {
+      printf("===\n[Distribution]\n");
+    } else {
+      char start_buff[32];
+      char end_buff[32];
+      wt_date_str_from_day(window->start_day, sizeof(start_buff), start_buff);
+      wt_date_str_from_day(window->start_day + dist.window_days - 1,
+                           sizeof(end_buff), end_buff);
+      printf("===\n[Distribution %s - %s]\n", start_buff, end_buff);
+    }
+    printf("  %-12s%8s%8s%8s%8s%8s%8s%8s%8s\n", "", "N", "Min", "P10", "P25",
+           "Median", "P75", "P90", "Max");
+    wt_sketch_print("Weight (Kg)", &window->weight_kg);
+    wt_sketch_print("BF (%)", &window->body_fat_percent);
+    wt_sketch_print("MM (%)", &window->muscle_mass_percent);
+    wt_sketch_print("WM (%)", &window->water_mass_percent);
+  }
+  if (dist.length != 0) {
+    printf("===\n");
+  }
+cleanup:
+  free(line);
+  wt_dist_free(&dist);
+  return res;
+}
+
+/// Removes `--profile <name>` from `argv`, wherever it appears, so that the
+/// commands below only see their own arguments.
+static int parse_profile(int *argc, char *argv[], char const **profile) {
+  *profile = WT_PROFILE_DEFAULT;
+  for (int i = 1; i < *argc; i++) {
+    if (strcmp(argv[i], "--profile") != 0) {
+      continue;
+    }
+    if (i + 1 == *argc) {
+      return -1;
+    }
+    *profile = argv[i + 1];
+    memmove(&argv[i], &argv[i + 2], (*argc - i - 2) * sizeof(*argv));
+    *argc -= 2;
+    i--;
+  }
+  return 0;
+}
+
+/// Parses `--from <date>` or `--to <date>` at `argv[*i]`. Returns 1 if it was
+/// one of them, 0 if not, and -1 on an invalid or empty range.
+static int parse_range(int argc, char *argv[], int *i, int32_t *from_day,
+                       int32_t *to_day) {
+  int32_t *day;
+  if (strcmp(argv[*i], "--from") == 0) {
+    day = from_day;
+  } else if (strcmp(argv[*i], "--to") == 0) {
+    day = to_day;
+  } else {
+    return 0;
+  }
+  if (*i + 1 == argc || wt_day_from_date_str(argv[++*i], day) < 0 ||
+      *from_day > *to_day) {
+    return -1;
+  }
+  return 1;
+}
+
 static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
   int res = -1;
+  char const *profile;
+  if (parse_profile(&argc, argv, &profile) < 0) {
+    res = -1;
+    goto exit;
+  }
   if (argc < 2) {
     res = -1;
     goto exit;
@@ -603,10 +2503,7 @@ static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
       cmd->tag = WT_CMD_LOG_WEIGHT;
       cmd->execute_func = log_weight;
       cmd->log_weight_args.weight = strtof(argv[2], NULL);
-      char const *home = getenv("HOME");
-      int length = snprintf(cmd->log_weight_args.file_path, FILE_PATH_MAX_SIZE,
-                            "%s/%s", home, WEIGHT_HISTORY_DEFAULT_FILE);
-      if (length == FILE_PATH_MAX_SIZE) {
+      if (wt_store_init(&cmd->log_weight_args.store, profile) < 0) {
         res = -1;
         goto exit;
       }
@@ -618,10 +2515,7 @@ static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
         res = -1;
         goto exit;
       }
-      char const *home = getenv("HOME");
-      int length = snprintf(cmd->log_data_args.file_path, FILE_PATH_MAX_SIZE,
-                            "%s/%s", home, WEIGHT_HISTORY_DEFAULT_FILE);
-      if (length == FILE_PATH_MAX_SIZE) {
+      if (wt_store_init(&cmd->log_data_args.store, profile) < 0) {
         res = -1;
         goto exit;
       }
@@ -632,12 +2526,10 @@ static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
   } else if (strcmp(argv[1], "avg") == 0) {
     cmd->tag = WT_CMD_AVG;
     cmd->execute_func = avg;
-    if (argc == 2) {
+    if (argc == 2 || (argc == 3 && strcmp(argv[2], "--no-fill") == 0)) {
       cmd->avg_args.avg_window_days = WT_AVG_DEFAULT_WINDOW_LENGTH_DAYS;
-      char const *home = getenv("HOME");
-      int length = snprintf(cmd->avg_args.file_path, FILE_PATH_MAX_SIZE,
-                            "%s/%s", home, WEIGHT_HISTORY_DEFAULT_FILE);
-      if (length == FILE_PATH_MAX_SIZE) {
+      cmd->avg_args.fill_gaps = argc == 2;
+      if (wt_store_init(&cmd->avg_args.store, profile) < 0) {
         res = -1;
         goto exit;
       }
@@ -648,12 +2540,10 @@ static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
   } else if (strcmp(argv[1], "stats") == 0) {
     cmd->tag = WT_CMD_STATS;
     cmd->execute_func = stats;
-    if (argc == 2) {
+    if (argc == 2 || (argc == 3 && strcmp(argv[2], "--no-fill") == 0)) {
       cmd->stats_args.avg_window_days = WT_AVG_DEFAULT_WINDOW_LENGTH_DAYS;
-      char const *home = getenv("HOME");
-      int length = snprintf(cmd->stats_args.file_path, FILE_PATH_MAX_SIZE,
-                            "%s/%s", home, WEIGHT_HISTORY_DEFAULT_FILE);
-      if (length == FILE_PATH_MAX_SIZE) {
+      cmd->stats_args.fill_gaps = argc == 2;
+      if (wt_store_init(&cmd->stats_args.store, profile) < 0) {
         res = -1;
         goto exit;
       }
@@ -664,22 +2554,97 @@ static int parse_args(int argc, char *argv[], struct wt_cmd *cmd) {
   } else if (strcmp(argv[1], "show") == 0) {
     cmd->tag = WT_CMD_SHOW;
     cmd->execute_func = show;
-    if (argc == 2) {
-      char const *home = getenv("HOME");
-      int length = snprintf(cmd->show_args.file_path, FILE_PATH_MAX_SIZE,
-                            "%s/%s", home, WEIGHT_HISTORY_DEFAULT_FILE);
-      if (length == FILE_PATH_MAX_SIZE) {
+    cmd->show_args.file_path[0] = '\0';
+    cmd->show_args.from_day = INT32_MIN;
+    cmd->show_args.to_day = INT32_MAX;
+    int i = 2;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+      if (parse_range(argc, argv, &i, &cmd->show_args.from_day,
+                      &cmd->show_args.to_day) != 1) {
+        res = -1;
+        goto exit;
+      }
+    }
+    if (i == argc) {
+      if (wt_store_init(&cmd->show_args.store, profile) < 0) {
         res = -1;
         goto exit;
       }
-    } else if (argc == 3) {
+    } else if (i == argc - 1 && i == 2) {
       if (strlen(argv[2]) >= FILE_PATH_MAX_SIZE) {
         res = -1;
         goto exit;
       }
       strcpy(cmd->show_args.file_path, argv[2]);
     } else {
-      assert(0 && "not implemented");
+      res = -1;
+      goto exit;
+    }
+    res = 0;
+  } else if (strcmp(argv[1], "dist") == 0) {
+    cmd->tag = WT_CMD_DIST;
+    cmd->execute_func = dist;
+    memset(&cmd->dist_args, 0, sizeof(cmd->dist_args));
+    cmd->dist_args.from_day = INT32_MIN;
+    cmd->dist_args.to_day = INT32_MAX;
+    bool ranged = false;
+    int i = 2;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+      int const range = parse_range(argc, argv, &i, &cmd->dist_args.from_day,
+                                    &cmd->dist_args.to_day);
+      if (range < 0) {
+        res = -1;
+        goto exit;
+      }
+      ranged = ranged || range == 1;
+      if (range == 1) {
+        continue;
+      } else if (strcmp(argv[i], "--merge") == 0) {
+        cmd->dist_args.merge = true;
+      } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+        char *end;
+        errno = 0;
+        long const window_days = strtol(argv[++i], &end, 10);
+        if (errno != 0 || end == argv[i] || *end != '\0' || window_days < 1 ||
+            window_days > WT_DIST_MAX_WINDOW_DAYS) {
+          res = -1;
+          goto exit;
+        }
+        cmd->dist_args.window_days = window_days;
+      } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+        if (strlen(argv[++i]) >= FILE_PATH_MAX_SIZE) {
+          res = -1;
+          goto exit;
+        }
+        strcpy(cmd->dist_args.save_path, argv[i]);
+      } else {
+        res = -1;
+        goto exit;
+      }
+    }
+    cmd->dist_args.inputs = &argv[i];
+    cmd->dist_args.input_count = argc - i;
+    if (cmd->dist_args.merge &&
+        (cmd->dist_args.input_count == 0 || ranged)) {
+      res = -1;
+      goto exit;
+    }
+    if (wt_store_init(&cmd->dist_args.store, profile) < 0) {
+      res = -1;
+      goto exit;
+    }
+    res = 0;
+  } else if (strcmp(argv[1], "compact") == 0) {
+    cmd->tag = WT_CMD_COMPACT;
+    cmd->execute_func = compact;
+    if (argc == 2) {
+      if (wt_store_init(&cmd->compact_args.store, profile) < 0) {
+        res = -1;
+        goto exit;
+      }
+    } else {
+      res = -1;
+      goto exit;
     }
     res = 0;
   } else {